@@ -10,6 +10,11 @@ OPENMP_OUTPUT="src/results-openmp.txt"
 OMP_MPI_OUTPUT="src/results-omp-mpi.txt"
 CUDA_OUTPUT="src/results-cuda.txt"       # Arquivo de saída para CUDA
 OPENMP_GPU_OUTPUT="src/results-openmp-gpu.txt"  # Novo arquivo de saída para OpenMP GPU
+CORESET_OUTPUT="src/results-coreset.txt"  # Arquivo de saída do pipeline com coreset
+CORESET_EPS=0.1                           # Erro relativo alvo do coreset
+SWEEP_OUTPUT="src/results-sweep.txt"      # Rótulos do melhor k da varredura
+SWEEP_K_MIN=2                             # Faixa de k da varredura
+SWEEP_K_MAX=30
 RESULTS_FILE="src/results.txt"
 
 # Apagando os arquivos de resultados no início
@@ -19,6 +24,8 @@ RESULTS_FILE="src/results.txt"
 > $SEQUENTIAL_OUTPUT
 > $CUDA_OUTPUT          # Limpa o arquivo de saída da CUDA
 > $OPENMP_GPU_OUTPUT    # Limpa o arquivo de saída da OpenMP GPU
+> $CORESET_OUTPUT       # Limpa o arquivo de saída do coreset
+> $SWEEP_OUTPUT         # Limpa o arquivo de saída da varredura de k
 
 # Exibindo as informações dos parâmetros de entrada
 echo "Executando o programa K-means com os seguintes parâmetros:" | tee -a $RESULTS_FILE
@@ -54,8 +61,16 @@ calc_speedup() {
 }
 
 # Compilação dos códigos
+echo "Compilando o carregador residente do dataset..." | tee -a $RESULTS_FILE
+gcc src/kmeans-loader.c -o src/kmeans-loader -lrt
+if [ $? -ne 0 ]; then
+    echo "Erro ao compilar kmeans-loader.c"
+    exit 1
+fi
+echo "Compilação do carregador concluída com sucesso!" | tee -a $RESULTS_FILE
+
 echo "Compilando o programa K-means sequencial..." | tee -a $RESULTS_FILE
-gcc src/kmeans-sequencial.c -o src/kmeans-sequencial -lm
+gcc src/kmeans-sequencial.c -o src/kmeans-sequencial -lm -lrt
 if [ $? -ne 0 ]; then
     echo "Erro ao compilar kmeans-sequencial.c"
     exit 1
@@ -63,7 +78,7 @@ fi
 echo "Compilação do K-means sequencial concluída com sucesso!" | tee -a $RESULTS_FILE
 
 echo "Compilando o programa K-means com OpenMP..." | tee -a $RESULTS_FILE
-gcc -fopenmp src/kmeans-openmp.c -o src/kmeans-openmp -lm
+gcc -fopenmp src/kmeans-openmp.c -o src/kmeans-openmp -lm -lrt
 if [ $? -ne 0 ]; then
     echo "Erro ao compilar kmeans-openmp.c"
     exit 1
@@ -71,7 +86,7 @@ fi
 echo "Compilação do K-means com OpenMP concluída com sucesso!" | tee -a $RESULTS_FILE
 
 echo "Compilando o programa K-means com OpenMP e MPI..." | tee -a $RESULTS_FILE
-mpicc -fopenmp src/kmeans-omp-mpi.c -o src/kmeans-omp-mpi -lm
+mpicc -fopenmp src/kmeans-omp-mpi.c -o src/kmeans-omp-mpi -lm -lrt
 if [ $? -ne 0 ]; then
     echo "Erro ao compilar kmeans-omp-mpi.c"
     exit 1
@@ -80,7 +95,7 @@ echo "Compilação do K-means com OpenMP e MPI concluída com sucesso!" | tee -a
 
 echo "Compilando o programa K-means com CUDA..." | tee -a $RESULTS_FILE
 # Especificando a arquitetura sm_61 para a GT 1030
-nvcc -O3 -arch=sm_61 src/kmeans-cuda.cu -o src/kmeans-cuda -lm
+nvcc -O3 -arch=sm_61 src/kmeans-cuda.cu -o src/kmeans-cuda -lm -lrt
 if [ $? -ne 0 ]; then
     echo "Erro ao compilar kmeans-cuda.cu"
     exit 1
@@ -89,13 +104,21 @@ echo "Compilação do K-means com CUDA concluída com sucesso!" | tee -a $RESULT
 
 echo "Compilando o programa K-means com OpenMP para GPU..." | tee -a $RESULTS_FILE
 # Compilando com gcc8 e -fopenmp
-gcc8 -O3 -fopenmp src/kmeans-omp-gpu.c -o src/kmeans-omp-gpu -lm
+gcc8 -O3 -fopenmp src/kmeans-omp-gpu.c -o src/kmeans-omp-gpu -lm -lrt
 if [ $? -ne 0 ]; then
     echo "Erro ao compilar kmeans-omp-gpu.c"
     exit 1
 fi
 echo "Compilação do K-means com OpenMP para GPU concluída com sucesso!" | tee -a $RESULTS_FILE
 
+# Carregando o dataset uma única vez em memória compartilhada
+# Todas as execuções seguintes se anexam ao segmento em vez de reler o CSV
+echo -e "\nCarregando o dataset em memória compartilhada..." | tee -a $RESULTS_FILE
+./src/kmeans-loader "$DATA_FILE" "$N" "$M" | tee -a $RESULTS_FILE
+# Remove o segmento ao sair do script, inclusive em caso de erro ou Ctrl-C
+trap './src/kmeans-loader --unlink "$DATA_FILE" > /dev/null 2>&1' EXIT
+trap 'exit 1' INT TERM
+
 # Executando a versão sequencial e exibindo o tempo de execução
 echo -e "\nExecutando o K-means sequencial..." | tee -a $RESULTS_FILE
 SEQ_TIME=$( { time ./src/kmeans-sequencial "$DATA_FILE" "$N" "$M" "$K" "$SEQUENTIAL_OUTPUT"; } 2>&1 | tee >(grep "real" | awk '{print $2}') )
@@ -115,6 +138,21 @@ for threads in 1 2 4 8; do
     fi
 done
 
+# Testando o pipeline aproximado com coreset (OpenMP, 4 threads)
+# Com --compare, o programa roda também o K-means completo como referência e imprime tempo e inércia relativos
+echo -e "\nExecutando o K-means com coreset (eps = $CORESET_EPS) usando 4 threads..." | tee -a $RESULTS_FILE
+export OMP_NUM_THREADS=4
+CORESET_REPORT=$( { time ./src/kmeans-openmp "$DATA_FILE" "$N" "$M" "$K" "$CORESET_OUTPUT" --eps "$CORESET_EPS" --compare; } 2>&1 )
+echo "$CORESET_REPORT" | grep -E "^(Full|Coreset)" | tee -a $RESULTS_FILE
+
+# Varredura de k numa única execução (OpenMP, 4 threads), com inércia e silhueta por k
+echo -e "\nExecutando a varredura de k de $SWEEP_K_MIN a $SWEEP_K_MAX usando 4 threads..." | tee -a $RESULTS_FILE
+export OMP_NUM_THREADS=4
+SWEEP_REPORT=$( { time ./src/kmeans-openmp "$DATA_FILE" "$N" "$M" "$SWEEP_K_MIN" "$SWEEP_OUTPUT" --sweep "$SWEEP_K_MAX"; } 2>&1 )
+echo "$SWEEP_REPORT" | grep -E "^(k =|Best k)" | tee -a $RESULTS_FILE
+SWEEP_TIME_SEC=$(convert_to_seconds "$SWEEP_REPORT")
+echo "Tempo total da varredura: $SWEEP_TIME_SEC segundos" | tee -a $RESULTS_FILE
+
 # Testando a versão CUDA
 echo -e "\nExecutando o K-means com CUDA..." | tee -a $RESULTS_FILE
 CUDA_TIME=$( { time ./src/kmeans-cuda "$DATA_FILE" "$N" "$M" "$K" "$CUDA_OUTPUT"; } 2>&1 | tee >(grep "real" | awk '{print $2}') )
@@ -136,6 +174,7 @@ if [ $? -eq 0 ]; then
 fi
 
 # Testando as combinações de OpenMP e MPI
+# As redistribuições de linhas do balanceamento dinâmico vão para o relatório
 echo -e "\nExecutando o K-means com OpenMP e MPI..." | tee -a $RESULTS_FILE
 
 # 1 processo com 4 threads
@@ -143,6 +182,7 @@ export OMP_NUM_THREADS=4
 echo -e "\n"  # Linha em branco antes do tempo
 MPI_1_PROC_4_THREADS_TIME=$( { time mpirun -np 1 ./src/kmeans-omp-mpi "$DATA_FILE" "$N" "$M" "$K" "$OMP_MPI_OUTPUT"; } 2>&1 | tee >(grep "real" | awk '{print $2}') )
 MPI_1_PROC_4_THREADS_TIME_SEC=$(convert_to_seconds "$MPI_1_PROC_4_THREADS_TIME")
+echo "$MPI_1_PROC_4_THREADS_TIME" | grep -E "^(Rebalance|Iterations)" | tee -a $RESULTS_FILE
 echo "Tempo OpenMP e MPI (1 processo, 4 threads): $MPI_1_PROC_4_THREADS_TIME_SEC segundos" | tee -a $RESULTS_FILE
 SPEEDUP_1_PROC_4_THREADS=$(calc_speedup $SEQ_TIME_SEC $MPI_1_PROC_4_THREADS_TIME_SEC)
 if [ $? -eq 0 ]; then
@@ -154,6 +194,7 @@ export OMP_NUM_THREADS=2
 echo -e "\n"  # Linha em branco antes do tempo
 MPI_2_PROC_2_THREADS_TIME=$( { time mpirun -np 2 ./src/kmeans-omp-mpi "$DATA_FILE" "$N" "$M" "$K" "$OMP_MPI_OUTPUT"; } 2>&1 | tee >(grep "real" | awk '{print $2}') )
 MPI_2_PROC_2_THREADS_TIME_SEC=$(convert_to_seconds "$MPI_2_PROC_2_THREADS_TIME")
+echo "$MPI_2_PROC_2_THREADS_TIME" | grep -E "^(Rebalance|Iterations)" | tee -a $RESULTS_FILE
 echo "Tempo OpenMP e MPI (2 processos, 2 threads): $MPI_2_PROC_2_THREADS_TIME_SEC segundos" | tee -a $RESULTS_FILE
 SPEEDUP_2_PROC_2_THREADS=$(calc_speedup $SEQ_TIME_SEC $MPI_2_PROC_2_THREADS_TIME_SEC)
 if [ $? -eq 0 ]; then
@@ -165,6 +206,7 @@ export OMP_NUM_THREADS=1
 echo -e "\n"  # Linha em branco antes do tempo
 MPI_4_PROC_NO_THREADS_TIME=$( { time mpirun -np 4 ./src/kmeans-omp-mpi "$DATA_FILE" "$N" "$M" "$K" "$OMP_MPI_OUTPUT"; } 2>&1 | tee >(grep "real" | awk '{print $2}') )
 MPI_4_PROC_NO_THREADS_TIME_SEC=$(convert_to_seconds "$MPI_4_PROC_NO_THREADS_TIME")
+echo "$MPI_4_PROC_NO_THREADS_TIME" | grep -E "^(Rebalance|Iterations)" | tee -a $RESULTS_FILE
 echo "Tempo OpenMP e MPI (4 processos, sem threads): $MPI_4_PROC_NO_THREADS_TIME_SEC segundos" | tee -a $RESULTS_FILE
 SPEEDUP_4_PROC_NO_THREADS=$(calc_speedup $SEQ_TIME_SEC $MPI_4_PROC_NO_THREADS_TIME_SEC)
 if [ $? -eq 0 ]; then
@@ -174,6 +216,8 @@ fi
 echo -e "\nExecuções concluídas." | tee -a $RESULTS_FILE
 echo "Resultados do K-means sequencial estão em $SEQUENTIAL_OUTPUT" | tee -a $RESULTS_FILE
 echo "Resultados do K-means com OpenMP estão em $OPENMP_OUTPUT" | tee -a $RESULTS_FILE
+echo "Resultados do K-means com coreset estão em $CORESET_OUTPUT" | tee -a $RESULTS_FILE
+echo "Resultados do melhor k da varredura estão em $SWEEP_OUTPUT" | tee -a $RESULTS_FILE
 echo "Resultados do K-means com CUDA estão em $CUDA_OUTPUT" | tee -a $RESULTS_FILE
 echo "Resultados do K-means com OpenMP GPU estão em $OPENMP_GPU_OUTPUT" | tee -a $RESULTS_FILE
 echo "Resultados do K-means com OpenMP e MPI estão em $OMP_MPI_OUTPUT" | tee -a $RESULTS_FILE
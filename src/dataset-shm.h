@@ -0,0 +1,110 @@
+/*
+Cache do dataset em memória compartilhada POSIX
+
+O kmeans-loader lê e converte o CSV uma única vez para um segmento
+/dev/shm nomeado a partir do caminho do arquivo. As versões do K-means
+tentam se anexar a esse segmento em modo somente leitura (sem cópia) e,
+se ele não existir ou o cabeçalho não bater, voltam a ler o CSV.
+*/
+#ifndef DATASET_SHM_H
+#define DATASET_SHM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define DATASET_SHM_MAGIC 0x314D534E41454D4BULL /* "KMEANSM1" */
+#define DATASET_SHM_VERSION 1
+#define DATASET_SHM_HEADER_SIZE 64              /* mantém os dados alinhados */
+
+// Cabeçalho gravado no início do segmento; o magic é escrito por último
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t n_values;       // número de doubles após o cabeçalho
+    uint64_t src_size;       // tamanho do CSV de origem
+    int64_t src_mtime_sec;   // data de modificação do CSV de origem
+    int64_t src_mtime_nsec;
+} dataset_shm_header;
+
+// Nome do segmento: "/kmeans-" + hash FNV-1a do caminho absoluto do CSV
+static inline int dataset_shm_name(const char *fn, char *name, size_t len) {
+    char path[PATH_MAX];
+    if (realpath(fn, path) == NULL) return -1;
+    uint64_t h = 0xCBF29CE484222325ULL;
+    for (const char *c = path; *c; c++) {
+        h = (h ^ (unsigned char)*c) * 0x100000001B3ULL;
+    }
+    snprintf(name, len, "/kmeans-%016llx", (unsigned long long)h);
+    return 0;
+}
+
+// Preenche os campos que identificam o CSV de origem
+static inline int dataset_shm_source(const char *fn, dataset_shm_header *hd) {
+    struct stat st;
+    if (stat(fn, &st) != 0) return -1;
+    hd->src_size = (uint64_t)st.st_size;
+    hd->src_mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    hd->src_mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    return 0;
+}
+
+static inline size_t dataset_shm_bytes(size_t n_values) {
+    return DATASET_SHM_HEADER_SIZE + n_values * sizeof(double);
+}
+
+// Anexa o segmento do arquivo fn em modo somente leitura e devolve o ponteiro
+// para os n_values doubles, ou NULL se o cache não existir ou for inválido
+// (outro arquivo, CSV modificado, outro n * m). Nunca escreva nesse ponteiro.
+static inline double *dataset_shm_attach(const char *fn, size_t n_values) {
+    char name[64];
+    dataset_shm_header expected;
+    if (dataset_shm_name(fn, name, sizeof(name)) != 0) return NULL;
+    if (dataset_shm_source(fn, &expected) != 0) return NULL;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    size_t bytes = dataset_shm_bytes(n_values);
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size != bytes) {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    const dataset_shm_header *hd = (const dataset_shm_header *)base;
+    if (hd->magic != DATASET_SHM_MAGIC || hd->version != DATASET_SHM_VERSION ||
+        hd->header_size != DATASET_SHM_HEADER_SIZE || hd->n_values != n_values ||
+        hd->src_size != expected.src_size || hd->src_mtime_sec != expected.src_mtime_sec ||
+        hd->src_mtime_nsec != expected.src_mtime_nsec) {
+        munmap(base, bytes);
+        return NULL;
+    }
+    return (double *)((char *)base + DATASET_SHM_HEADER_SIZE);
+}
+
+// Desfaz o mapeamento criado por dataset_shm_attach
+static inline void dataset_shm_detach(double *x, size_t n_values) {
+    munmap((char *)x - DATASET_SHM_HEADER_SIZE, dataset_shm_bytes(n_values));
+}
+
+// Libera x conforme a origem: segmento compartilhado ou malloc
+static inline void dataset_release(double *x, size_t n_values, int shared) {
+    if (shared) {
+        dataset_shm_detach(x, n_values);
+    } else {
+        free(x);
+    }
+}
+
+#endif
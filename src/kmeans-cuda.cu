@@ -3,6 +3,7 @@
 #include <math.h>
 #include <float.h>
 #include <cuda.h>
+#include "dataset-shm.h"
 
 // Função para calcular a distância euclidiana (no host, para inicialização)
 __host__ double euclidean_distance_host(double *a, double *b, int m) {
@@ -99,7 +100,10 @@ int main(int argc, char **argv) {
     }
 
     // Alocação de memória no host
-    double *h_x = (double*)malloc(n * m * sizeof(double));
+    // Usa o cache em memória compartilhada do kmeans-loader, se existir
+    double *h_x = dataset_shm_attach(argv[1], (size_t)n * m);
+    const int x_shared = h_x != NULL;
+    if (!x_shared) h_x = (double*)malloc(n * m * sizeof(double));
     if (h_x == NULL) {
         puts("Erro na alocação de memória para x...");
         exit(1);
@@ -108,18 +112,18 @@ int main(int argc, char **argv) {
     int *h_y = (int*)malloc(n * sizeof(int));
     if (h_y == NULL) {
         puts("Erro na alocação de memória para y...");
-        free(h_x);
+        dataset_release(h_x, (size_t)n * m, x_shared);
         exit(1);
     }
 
     // Leitura dos dados
-    fscanf_data(argv[1], h_x, n * m);
+    if (!x_shared) fscanf_data(argv[1], h_x, n * m);
 
     // Inicialização dos centróides (primeiros k pontos)
     double *h_centroids = (double*)malloc(k * m * sizeof(double));
     if (h_centroids == NULL) {
         puts("Erro na alocação de memória para centróides...");
-        free(h_x);
+        dataset_release(h_x, (size_t)n * m, x_shared);
         free(h_y);
         exit(1);
     }
@@ -212,7 +216,7 @@ int main(int argc, char **argv) {
     fprintf_result(argv[5], h_y, n);
 
     // Liberação de memória
-    free(h_x);
+    dataset_release(h_x, (size_t)n * m, x_shared);
     free(h_y);
     free(h_centroids);
     free(h_y_prev);
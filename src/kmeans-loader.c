@@ -0,0 +1,100 @@
+/*
+Carregador residente do dataset
+Lê o CSV uma vez e publica os n * m valores em um segmento de memória
+compartilhada POSIX (ver dataset-shm.h). As execuções seguintes de qualquer
+versão do K-means se anexam ao segmento sem reler o arquivo.
+
+Uso: kmeans-loader <arquivo_dados> <n> <m>
+     kmeans-loader --unlink <arquivo_dados>
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dataset-shm.h"
+
+void fscanf_data(const char *fn, double *x, const int n) {
+    FILE *fl = fopen(fn, "r");
+    if (fl == NULL) {
+        printf("Error in opening %s file...\n", fn);
+        exit(1);
+    }
+    int i = 0;
+    while (i < n && !feof(fl)) {
+        if (fscanf(fl, "%lf", x + i) == 0) {}
+        i++;
+    }
+    fclose(fl);
+}
+
+// Recria o segmento do arquivo fn e converte o CSV diretamente para ele
+void publish_data(const char *fn, const char *name, size_t n_values) {
+    dataset_shm_header hd;
+    memset(&hd, 0, sizeof(hd));
+    if (dataset_shm_source(fn, &hd) != 0) {
+        printf("Error in opening %s file...\n", fn);
+        exit(1);
+    }
+
+    // Quem já está anexado ao segmento antigo mantém o seu mapeamento
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        printf("Error in creating shared memory segment %s...\n", name);
+        exit(1);
+    }
+    size_t bytes = dataset_shm_bytes(n_values);
+    if (ftruncate(fd, (off_t)bytes) != 0) {
+        printf("Error in sizing shared memory segment %s...\n", name);
+        shm_unlink(name);
+        exit(1);
+    }
+    void *base = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        printf("Error in mapping shared memory segment %s...\n", name);
+        shm_unlink(name);
+        exit(1);
+    }
+
+    fscanf_data(fn, (double *)((char *)base + DATASET_SHM_HEADER_SIZE), (int)n_values);
+
+    // O magic só é gravado depois dos dados: leitores concorrentes veem um
+    // cabeçalho inválido e voltam a ler o CSV
+    hd.version = DATASET_SHM_VERSION;
+    hd.header_size = DATASET_SHM_HEADER_SIZE;
+    hd.n_values = n_values;
+    memcpy(base, &hd, sizeof(hd));
+    __sync_synchronize();
+    ((dataset_shm_header *)base)->magic = DATASET_SHM_MAGIC;
+
+    munmap(base, bytes);
+}
+
+int main(int argc, char **argv) {
+    char name[64];
+    if (argc == 3 && strcmp(argv[1], "--unlink") == 0) {
+        if (dataset_shm_name(argv[2], name, sizeof(name)) != 0 || shm_unlink(name) != 0) {
+            printf("No shared memory segment for %s...\n", argv[2]);
+            exit(1);
+        }
+        printf("Removed %s\n", name);
+        return 0;
+    }
+    if (argc < 4) {
+        puts("Not enough parameters...");
+        puts("Usage: kmeans-loader <data> <n> <m> | kmeans-loader --unlink <data>");
+        exit(1);
+    }
+    const int n = atoi(argv[2]), m = atoi(argv[3]);
+    if (n < 1 || m < 1) {
+        puts("Values of input parameters are incorrect...");
+        exit(1);
+    }
+    if (dataset_shm_name(argv[1], name, sizeof(name)) != 0) {
+        printf("Error in opening %s file...\n", argv[1]);
+        exit(1);
+    }
+    publish_data(argv[1], name, (size_t)n * m);
+    printf("Loaded %d x %d values from %s into %s\n", n, m, argv[1], name);
+    return 0;
+}
@@ -8,6 +8,7 @@ Speedup: x.xx
 #include <math.h>
 #include <float.h>
 #include <omp.h>
+#include "dataset-shm.h"
 
 // Função para calcular a distância Euclidiana ao quadrado
 double euclidean_distance_squared(double *a, double *b, int m) {
@@ -157,7 +158,10 @@ int main(int argc, char **argv) {
         puts("Valores dos parâmetros de entrada estão incorretos...");
         exit(1);
     }
-    double *x = (double*)malloc(n * m * sizeof(double));
+    // Usa o cache em memória compartilhada do kmeans-loader, se existir
+    double *x = dataset_shm_attach(argv[1], (size_t)n * m);
+    const int x_shared = x != NULL;
+    if (!x_shared) x = (double*)malloc(n * m * sizeof(double));
     if (x == NULL) {
         puts("Erro na alocação de memória para os dados...");
         exit(1);
@@ -165,17 +169,17 @@ int main(int argc, char **argv) {
     int *y = (int*)malloc(n * sizeof(int));
     if (y == NULL) {
         puts("Erro na alocação de memória para os rótulos...");
-        free(x);
+        dataset_release(x, (size_t)n * m, x_shared);
         exit(1);
     }
     // Inicializar rótulos com -1
     for (int i = 0; i < n; i++) {
         y[i] = -1;
     }
-    fscanf_data(argv[1], x, n * m);
+    if (!x_shared) fscanf_data(argv[1], x, n * m);
     kmeans_gpu(x, y, n, m, k);
     fprintf_result(argv[5], y, n);
-    free(x);
+    dataset_release(x, (size_t)n * m, x_shared);
     free(y);
     return 0;
 }
\ No newline at end of file
@@ -15,11 +15,13 @@ Speedup: 3.63
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <math.h>
 #include <float.h>
 #include <omp.h>
 #include <mpi.h>
+#include "dataset-shm.h"
 
 double euclidean_distance(double *a, double *b, int m) {
     double sum = 0.0;
@@ -43,7 +45,71 @@ void fscanf_data(const char *fn, double *x, const int n) {
     fclose(fl);
 }
 
+// Parâmetros do balanceamento dinâmico de carga
+#define REBALANCE_PERIOD 4        // iterações entre medições
+#define REBALANCE_THRESHOLD 1.10  // desequilíbrio (max / média) que dispara a migração
+#define REBALANCE_MIN_GAIN 0.05   // redução mínima prevista do desequilíbrio para migrar
+#define RATE_SMOOTHING 0.5        // peso da medição nova na média móvel exponencial da vazão
+#define BLOCK_ROWS 1024           // granularidade das linhas migradas
+#define OMP_CHUNK 256             // tamanho do bloco do escalonamento dinâmico
+
+// Divisão inicial das linhas: o processo r fica com [bounds[r], bounds[r + 1])
+void split_rows(int *bounds, int n, int size) {
+    for (int r = 0; r <= size; r++) {
+        bounds[r] = (int)((long long)n * r / size);
+    }
+}
+
+// Desequilíbrio (max / média) previsto para as faixas bounds, estimando o tempo
+// de cada processo pelas linhas que ele tem e pela sua vazão (linhas por segundo)
+double predicted_imbalance(const int *bounds, const double *rate, int size) {
+    double max_time = 0.0, mean_time = 0.0;
+    for (int r = 0; r < size; r++) {
+        if (rate[r] <= 0.0) return 1.0;
+        double time = (bounds[r + 1] - bounds[r]) / rate[r];
+        if (time > max_time) max_time = time;
+        mean_time += time / size;
+    }
+    return mean_time > 0.0 ? max_time / mean_time : 1.0;
+}
+
+// Propõe em new_bounds faixas proporcionais à vazão de cada processo, em blocos
+// de BLOCK_ROWS. Todos os processos chegam ao mesmo resultado porque partem
+// das mesmas vazões. Devolve 0 se não houver vazão medida.
+int balance_rows(int *new_bounds, const double *rate, int n, int size) {
+    double total_rate = 0.0;
+    for (int r = 0; r < size; r++) {
+        total_rate += rate[r];
+    }
+    if (total_rate <= 0.0) return 0;
+
+    int min_rows = n / size < BLOCK_ROWS ? n / size : BLOCK_ROWS;
+    double acc = 0.0;
+    new_bounds[0] = 0;
+    for (int r = 1; r < size; r++) {
+        acc += rate[r - 1];
+        int b = (int)((long long)(n * (acc / total_rate) / BLOCK_ROWS + 0.5) * BLOCK_ROWS);
+        if (b < new_bounds[r - 1] + min_rows) b = new_bounds[r - 1] + min_rows;
+        if (b > n - (size - r) * min_rows) b = n - (size - r) * min_rows;
+        new_bounds[r] = b;
+    }
+    new_bounds[size] = n;
+    return 1;
+}
+
+// Linhas que mudam de dono entre as faixas bounds e new_bounds
+int moved_rows(const int *bounds, const int *new_bounds, int size) {
+    int moved = 0;
+    for (int r = 0; r < size; r++) {
+        int lo = new_bounds[r] > bounds[r] ? new_bounds[r] : bounds[r];
+        int hi = new_bounds[r + 1] < bounds[r + 1] ? new_bounds[r + 1] : bounds[r + 1];
+        moved += (bounds[r + 1] - bounds[r]) - (hi > lo ? hi - lo : 0);
+    }
+    return moved;
+}
+
 // Função principal do K-means com MPI e OpenMP
+// Ao final, y fica completo no processo mestre.
 void kmeans(double *x, int *y, int n, int m, int k, int rank, int size) {
     // Aloca memória para os centróides
     double **centroids = (double **)malloc(k * sizeof(double *));
@@ -65,14 +131,26 @@ void kmeans(double *x, int *y, int n, int m, int k, int rank, int size) {
         MPI_Bcast(centroids[i], m, MPI_DOUBLE, 0, MPI_COMM_WORLD);
     }
 
+    // Faixa de linhas de cada processo, ajustada durante a execução
+    int *bounds = (int *)malloc((size + 1) * sizeof(int));
+    int *counts = (int *)malloc(size * sizeof(int));
+    int *new_bounds = (int *)malloc((size + 1) * sizeof(int));
+    double *busy = (double *)malloc(size * sizeof(double));
+    double *rate = (double *)calloc(size, sizeof(double));
+    split_rows(bounds, n, size);
+    double local_busy = 0.0;
+    int iter = 0, rebalances = 0;
+
     int changed;
     do {
         changed = 0;
         int local_changed = 0;
+        const int first = bounds[rank], last = bounds[rank + 1];
+        double start = MPI_Wtime();
 
         // Atribui cada ponto ao centróide mais próximo (paralelizado com OpenMP)
-        #pragma omp parallel for reduction(+:local_changed) schedule(static)
-        for (int i = rank * (n / size); i < (rank + 1) * (n / size); i++) {
+        #pragma omp parallel for reduction(+:local_changed) schedule(dynamic, OMP_CHUNK)
+        for (int i = first; i < last; i++) {
             double min_dist = DBL_MAX;
             int closest_centroid = -1;
 
@@ -95,8 +173,8 @@ void kmeans(double *x, int *y, int n, int m, int k, int rank, int size) {
         double *local_sums = (double *)calloc(k * m, sizeof(double));
         int *local_counts = (int *)calloc(k, sizeof(int));
 
-        #pragma omp parallel for schedule(static)
-        for (int i = rank * (n / size); i < (rank + 1) * (n / size); i++) {
+        #pragma omp parallel for schedule(dynamic, OMP_CHUNK)
+        for (int i = first; i < last; i++) {
             int cluster = y[i];
             #pragma omp atomic
             local_counts[cluster]++;
@@ -107,6 +185,9 @@ void kmeans(double *x, int *y, int n, int m, int k, int rank, int size) {
             }
         }
 
+        // Só o trabalho local entra na medição, sem a comunicação
+        local_busy += MPI_Wtime() - start;
+
         // Reduz as somas e contagens para o processo mestre
         double *global_sums = (double *)calloc(k * m, sizeof(double));
         int *global_counts = (int *)calloc(k, sizeof(int));
@@ -136,13 +217,69 @@ void kmeans(double *x, int *y, int n, int m, int k, int rank, int size) {
         // Limpa a memória temporária
         free(local_sums);
         free(local_counts);
-        if (rank == 0) {
-            free(global_sums);
-            free(global_counts);
+        free(global_sums);
+        free(global_counts);
+
+        // Mede o tempo de cada processo e migra blocos de linhas se houver desequilíbrio
+        iter++;
+        if (changed && size > 1 && iter % REBALANCE_PERIOD == 0) {
+            MPI_Allgather(&local_busy, 1, MPI_DOUBLE, busy, 1, MPI_DOUBLE, MPI_COMM_WORLD);
+            local_busy = 0.0;
+
+            // Vazão suavizada por média móvel exponencial, para que uma
+            // medição ruidosa isolada não provoque uma migração
+            for (int r = 0; r < size; r++) {
+                if (busy[r] <= 0.0) continue;
+                double current = (bounds[r + 1] - bounds[r]) / busy[r];
+                rate[r] = rate[r] > 0.0 ? RATE_SMOOTHING * current + (1.0 - RATE_SMOOTHING) * rate[r] : current;
+            }
+            double imbalance = predicted_imbalance(bounds, rate, size);
+
+            // Só migra se a nova divisão reduzir o desequilíbrio por uma margem real
+            if (imbalance > REBALANCE_THRESHOLD && balance_rows(new_bounds, rate, n, size)) {
+                double predicted = predicted_imbalance(new_bounds, rate, size);
+                int moved = moved_rows(bounds, new_bounds, size);
+                if (moved > 0 && imbalance - predicted >= REBALANCE_MIN_GAIN) {
+                    // Antes de mudar as faixas, todos recebem os rótulos atuais
+                    // para que o novo dono de cada linha parta do rótulo correto
+                    for (int r = 0; r < size; r++) {
+                        counts[r] = bounds[r + 1] - bounds[r];
+                    }
+                    MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, y, counts, bounds, MPI_INT, MPI_COMM_WORLD);
+                    memcpy(bounds, new_bounds, (size + 1) * sizeof(int));
+
+                    rebalances++;
+                    if (rank == 0) {
+                        printf("Rebalance at iteration %d: imbalance %.3f -> %.3f (predicted), %d rows moved, rows per rank:",
+                               iter, imbalance, predicted, moved);
+                        for (int r = 0; r < size; r++) {
+                            printf(" %d", bounds[r + 1] - bounds[r]);
+                        }
+                        printf("\n");
+                    }
+                }
+            }
         }
 
     } while (changed);
 
+    // Junta os rótulos de todos os processos no mestre
+    for (int r = 0; r < size; r++) {
+        counts[r] = bounds[r + 1] - bounds[r];
+    }
+    if (rank == 0) {
+        MPI_Gatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, y, counts, bounds, MPI_INT, 0, MPI_COMM_WORLD);
+        printf("Iterations: %d, rebalances: %d\n", iter, rebalances);
+    } else {
+        MPI_Gatherv(y + bounds[rank], counts[rank], MPI_INT, NULL, NULL, NULL, MPI_INT, 0, MPI_COMM_WORLD);
+    }
+
+    free(bounds);
+    free(counts);
+    free(new_bounds);
+    free(busy);
+    free(rate);
+
     // Libera a memória dos centróides
     for (int i = 0; i < k; i++) {
         free(centroids[i]);
@@ -189,25 +326,40 @@ int main(int argc, char **argv) {
         MPI_Finalize();
         exit(1);
     }
-    double *x = (double*)malloc(n * m * sizeof(double));
+    // Cada processo tenta se anexar ao cache do kmeans-loader; se algum não
+    // conseguir (outro nó, cache ausente), todos voltam ao caminho com Bcast
+    double *x = dataset_shm_attach(argv[1], (size_t)n * m);
+    int x_shared = x != NULL, all_shared;
+    MPI_Allreduce(&x_shared, &all_shared, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    if (x_shared && !all_shared) {
+        dataset_shm_detach(x, (size_t)n * m);
+        x_shared = 0;
+    }
+    if (!x_shared) x = (double*)malloc(n * m * sizeof(double));
     int *y = (int*)malloc(n * sizeof(int));
 
     if (x == NULL || y == NULL) {
         if (rank == 0) puts("Memory allocation error...");
-        free(x);
+        if (x != NULL) dataset_release(x, (size_t)n * m, x_shared);
         free(y);
         MPI_Finalize();
         exit(1);
     }
 
-    if (rank == 0) fscanf_data(argv[1], x, n * m);
-    MPI_Bcast(x, n * m, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (!x_shared) {
+        if (rank == 0) fscanf_data(argv[1], x, n * m);
+        MPI_Bcast(x, n * m, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    }
+
+    for (int i = 0; i < n; i++) {
+        y[i] = -1;
+    }
 
     kmeans(x, y, n, m, k, rank, size);
 
     if (rank == 0) fprintf_result(argv[5], y, n, rank);
 
-    free(x);
+    dataset_release(x, (size_t)n * m, x_shared);
     free(y);
     MPI_Finalize();
     return 0;
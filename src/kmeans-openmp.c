@@ -19,12 +19,19 @@ Speedup: 3.25
 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
 #include <time.h>
 #include <math.h>
 #include <float.h>
 #include <omp.h>
+#include "dataset-shm.h"
 
-double euclidean_distance(double *a, double *b, int m) {
+#define CORESET_MIN_PER_CLUSTER 10  // tamanho mínimo do coreset derivado de eps, por cluster
+#define SILHOUETTE_SAMPLES 2000  // pontos usados na silhueta da varredura de k
+
+double euclidean_distance(const double *a, const double *b, int m) {
     double sum = 0.0;
     for (int i = 0; i < m; i++) {
         sum += (a[i] - b[i]) * (a[i] - b[i]);
@@ -47,20 +54,9 @@ void fscanf_data(const char *fn, double *x, const int n) {
 }
 
 // Função principal do K-means
-void kmeans(double *x, int *y, int n, int m, int k) {
-    // Aloca memória para os centróides
-    double **centroids = (double **)malloc(k * sizeof(double *));
-    for (int i = 0; i < k; i++) {
-        centroids[i] = (double *)malloc(m * sizeof(double));
-    }
-
-    // Inicializa os centróides com os primeiros k pontos (pode ser ajustado para inicialização aleatória)
-    for (int i = 0; i < k; i++) {
-        for (int j = 0; j < m; j++) {
-            centroids[i][j] = x[i * m + j];
-        }
-    }
-
+// w (opcional) dá o peso de cada ponto; NULL equivale a peso 1 para todos.
+// centroids (k * m) chega com a inicialização e sai com os centróides finais.
+void kmeans(const double *x, const double *w, int *y, int n, int m, int k, double *centroids) {
     int changed;
     do {
         changed = 0;
@@ -72,7 +68,7 @@ void kmeans(double *x, int *y, int n, int m, int k) {
             int closest_centroid = -1;
 
             for (int j = 0; j < k; j++) {
-                double dist = euclidean_distance(&x[i * m], centroids[j], m);
+                double dist = euclidean_distance(&x[i * m], &centroids[j * m], m);
                 if (dist < min_dist) {
                     min_dist = dist;
                     closest_centroid = j;
@@ -92,21 +88,22 @@ void kmeans(double *x, int *y, int n, int m, int k) {
         // Recalcula os centróides (paralelizado)
         #pragma omp parallel for schedule(static)
         for (int j = 0; j < k; j++) {
-            int cluster_size = 0;
+            double cluster_weight = 0.0;
             double *sum = (double *)calloc(m, sizeof(double));
 
-            // Soma as coordenadas de cada ponto no cluster
+            // Soma as coordenadas (ponderadas) de cada ponto no cluster
             #pragma omp parallel
             {
-                int cluster_size_local = 0;
+                double cluster_weight_local = 0.0;
                 double *sum_local = (double *)calloc(m, sizeof(double));
 
                 #pragma omp for schedule(static)
                 for (int i = 0; i < n; i++) {
                     if (y[i] == j) {
-                        cluster_size_local++;
+                        double wi = w ? w[i] : 1.0;
+                        cluster_weight_local += wi;
                         for (int l = 0; l < m; l++) {
-                            sum_local[l] += x[i * m + l];
+                            sum_local[l] += wi * x[i * m + l];
                         }
                     }
                 }
@@ -116,16 +113,16 @@ void kmeans(double *x, int *y, int n, int m, int k) {
                     for (int l = 0; l < m; l++) {
                         sum[l] += sum_local[l];
                     }
-                    cluster_size += cluster_size_local;
+                    cluster_weight += cluster_weight_local;
                 }
 
                 free(sum_local);
             }
 
             // Calcula a média para obter o novo centróide
-            if (cluster_size > 0) {
+            if (cluster_weight > 0.0) {
                 for (int l = 0; l < m; l++) {
-                    centroids[j][l] = sum[l] / cluster_size;
+                    centroids[j * m + l] = sum[l] / cluster_weight;
                 }
             }
 
@@ -133,12 +130,407 @@ void kmeans(double *x, int *y, int n, int m, int k) {
         }
 
     } while (changed);
+}
+
+// Inicializa os centróides com os primeiros k pontos (pode ser ajustado para inicialização aleatória)
+void init_centroids(const double *x, double *centroids, int m, int k) {
+    for (int i = 0; i < k * m; i++) {
+        centroids[i] = x[i];
+    }
+}
+
+// Atribui todos os n pontos ao centróide mais próximo e devolve a inércia
+// (soma das distâncias ao quadrado)
+double assign_labels(const double *x, int *y, int n, int m, const double *centroids, int k) {
+    double inertia = 0.0;
+
+    #pragma omp parallel for reduction(+:inertia) schedule(static)
+    for (int i = 0; i < n; i++) {
+        double min_dist = DBL_MAX;
+        int closest_centroid = -1;
+
+        for (int j = 0; j < k; j++) {
+            double dist = euclidean_distance(&x[i * m], &centroids[j * m], m);
+            if (dist < min_dist) {
+                min_dist = dist;
+                closest_centroid = j;
+            }
+        }
+
+        y[i] = closest_centroid;
+        inertia += min_dist * min_dist;
+    }
+
+    return inertia;
+}
+
+// Número uniforme em [0, 1) derivado de (seed, i) com splitmix64, para que
+// a amostragem não dependa do número de threads
+double hash_uniform(unsigned long long seed, unsigned long long i) {
+    unsigned long long z = seed + (i + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z = z ^ (z >> 31);
+    return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Tamanho do coreset para um erro relativo eps: t = (m k ln(k+1)) / eps^2
+// (limite dos coresets leves sem a constante, usado como heurística).
+// O mínimo de CORESET_MIN_PER_CLUSTER pontos por cluster deixa folga para a
+// amostragem de Poisson, que só acerta t em média.
+int coreset_size_for_error(int m, int k, double eps, int n) {
+    double t = ceil((m * k * log(k + 1.0)) / (eps * eps));
+    if (t < (double)CORESET_MIN_PER_CLUSTER * k) t = (double)CORESET_MIN_PER_CLUSTER * k;
+    if (t > n) return n;
+    return (int)t;
+}
+
+// Constrói um coreset leve (Bachem et al., 2018) de tamanho esperado t.
+// A média e a soma das distâncias à média saem de uma redução única
+// (soma de d^2 = soma de |x|^2 - n |media|^2); em seguida uma passagem
+// paralela em fluxo inclui cada ponto com probabilidade
+// p = min(1, t q(x)), q(x) = 1/(2n) + d(x, media)^2 / (2 soma de d^2),
+// e peso 1/p. Devolve o número de pontos escolhidos em *cx / *cw.
+int build_coreset(const double *x, int n, int m, int t, unsigned long long seed, double **cx, double **cw) {
+    double *mean = (double *)calloc(m, sizeof(double));
+    if (mean == NULL) {
+        puts("Memory allocation error...");
+        exit(1);
+    }
+    double sq_norm = 0.0;
+
+    #pragma omp parallel for reduction(+:mean[:m], sq_norm) schedule(static)
+    for (int i = 0; i < n; i++) {
+        for (int l = 0; l < m; l++) {
+            mean[l] += x[i * m + l];
+            sq_norm += x[i * m + l] * x[i * m + l];
+        }
+    }
+
+    double mean_sq_norm = 0.0;
+    for (int l = 0; l < m; l++) {
+        mean[l] /= n;
+        mean_sq_norm += mean[l] * mean[l];
+    }
+    double total_dist = sq_norm - n * mean_sq_norm;
+    if (total_dist <= 0.0) total_dist = 1.0;
+
+    int nthreads = omp_get_max_threads();
+    int **picked = (int **)calloc(nthreads, sizeof(int *));
+    double **picked_w = (double **)calloc(nthreads, sizeof(double *));
+    int *picked_count = (int *)calloc(nthreads, sizeof(int));
+    if (picked == NULL || picked_w == NULL || picked_count == NULL) {
+        puts("Memory allocation error...");
+        exit(1);
+    }
+
+    // Cada thread guarda os pontos escolhidos no seu trecho contíguo;
+    // a concatenação em ordem de thread preserva a ordem original
+    #pragma omp parallel num_threads(nthreads)
+    {
+        int tid = omp_get_thread_num();
+        int cap = t / nthreads + 16;
+        int cnt = 0;
+        int *idx = (int *)malloc(cap * sizeof(int));
+        double *wt = (double *)malloc(cap * sizeof(double));
+        if (idx == NULL || wt == NULL) {
+            puts("Memory allocation error...");
+            exit(1);
+        }
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            double d = 0.0;
+            for (int l = 0; l < m; l++) {
+                double diff = x[i * m + l] - mean[l];
+                d += diff * diff;
+            }
+            double p = t * (0.5 / n + 0.5 * d / total_dist);
+            if (p > 1.0) p = 1.0;
+            if (hash_uniform(seed, i) < p) {
+                if (cnt == cap) {
+                    cap *= 2;
+                    int *idx_grown = (int *)realloc(idx, cap * sizeof(int));
+                    double *wt_grown = (double *)realloc(wt, cap * sizeof(double));
+                    if (idx_grown == NULL || wt_grown == NULL) {
+                        puts("Memory allocation error...");
+                        exit(1);
+                    }
+                    idx = idx_grown;
+                    wt = wt_grown;
+                }
+                idx[cnt] = i;
+                wt[cnt] = 1.0 / p;
+                cnt++;
+            }
+        }
+
+        picked[tid] = idx;
+        picked_w[tid] = wt;
+        picked_count[tid] = cnt;
+    }
+
+    int size = 0;
+    for (int tid = 0; tid < nthreads; tid++) {
+        size += picked_count[tid];
+    }
+
+    *cx = (double *)malloc((size_t)size * m * sizeof(double));
+    *cw = (double *)malloc((size_t)size * sizeof(double));
+    if (*cx == NULL || *cw == NULL) {
+        puts("Memory allocation error...");
+        exit(1);
+    }
+    int pos = 0;
+    for (int tid = 0; tid < nthreads; tid++) {
+        for (int c = 0; c < picked_count[tid]; c++, pos++) {
+            for (int l = 0; l < m; l++) {
+                (*cx)[pos * m + l] = x[picked[tid][c] * m + l];
+            }
+            (*cw)[pos] = picked_w[tid][c];
+        }
+        free(picked[tid]);
+        free(picked_w[tid]);
+    }
+
+    free(picked);
+    free(picked_w);
+    free(picked_count);
+    free(mean);
+    return size;
+}
+
+// Pipeline aproximado: coreset -> K-means ponderado no coreset -> atribuição
+// de todos os n pontos. Os rótulos finais ficam em y. Com compare, roda
+// também o K-means completo como referência e imprime tempo e inércia relativos.
+void kmeans_coreset(const double *x, int *y, int n, int m, int k, int t, int compare) {
+    double *centroids = (double *)malloc(k * m * sizeof(double));
+    double *initial = (double *)malloc(k * m * sizeof(double));
+    if (centroids == NULL || initial == NULL) {
+        puts("Memory allocation error...");
+        exit(1);
+    }
+
+    // Os dois K-means partem dos mesmos centróides, tirados de x, para que a
+    // razão de inércia meça o erro do coreset e não a inicialização
+    init_centroids(x, initial, m, k);
+
+    double start = omp_get_wtime();
+    double *cx, *cw;
+    int size = build_coreset(x, n, m, t, 42, &cx, &cw);
+    // Se a amostra saiu com menos de k pontos, refaz com o dobro do tamanho
+    // esperado; com t >= 2n todo ponto tem p = 1, então o laço termina
+    while (size < k) {
+        free(cx);
+        free(cw);
+        t = t > n ? 2 * n : 2 * t;
+        size = build_coreset(x, n, m, t, 42, &cx, &cw);
+    }
+    double build_time = omp_get_wtime() - start;
+
+    int *cy = (int *)malloc(size * sizeof(int));
+    if (cy == NULL) {
+        puts("Memory allocation error...");
+        exit(1);
+    }
+    for (int i = 0; i < size; i++) cy[i] = -1;
+    memcpy(centroids, initial, k * m * sizeof(double));
+    kmeans(cx, cw, cy, size, m, k, centroids);
+    double core_inertia = assign_labels(x, y, n, m, centroids, k);
+    double core_time = omp_get_wtime() - start;
+
+    printf("Coreset k-means (t = %d, %d points): %.3f s (build %.3f s), inertia %.6e\n",
+           t, size, core_time, build_time, core_inertia);
+
+    free(cx);
+    free(cw);
+    free(cy);
+
+    // Referência opcional: K-means completo
+    if (compare) {
+        int *y_full = (int *)malloc(n * sizeof(int));
+        if (y_full == NULL) {
+            puts("Memory allocation error...");
+            exit(1);
+        }
+        start = omp_get_wtime();
+        for (int i = 0; i < n; i++) y_full[i] = -1;
+        memcpy(centroids, initial, k * m * sizeof(double));
+        kmeans(x, NULL, y_full, n, m, k, centroids);
+        double full_time = omp_get_wtime() - start;
+        double full_inertia = assign_labels(x, y_full, n, m, centroids, k);
+
+        printf("Full k-means: %.3f s, inertia %.6e\n", full_time, full_inertia);
+        if (full_inertia > 0.0) {
+            printf("Coreset vs full: speedup %.2f, inertia ratio %.4f\n",
+                   full_time / core_time, core_inertia / full_inertia);
+        } else {
+            printf("Coreset vs full: speedup %.2f, inertia ratio undefined (full inertia is 0)\n",
+                   full_time / core_time);
+        }
+        free(y_full);
+    }
+
+    free(centroids);
+    free(initial);
+}
+
+// Inércia de cada cluster (sse[j]) para rótulos já convergidos; devolve o total
+double cluster_sse(const double *x, const int *y, int n, int m, const double *centroids, int k, double *sse) {
+    for (int j = 0; j < k; j++) sse[j] = 0.0;
+
+    #pragma omp parallel for reduction(+:sse[:k]) schedule(static)
+    for (int i = 0; i < n; i++) {
+        double dist = euclidean_distance(&x[i * m], &centroids[y[i] * m], m);
+        sse[y[i]] += dist * dist;
+    }
+
+    double total = 0.0;
+    for (int j = 0; j < k; j++) total += sse[j];
+    return total;
+}
+
+// Silhueta média sobre uma amostra de pontos igualmente espaçados
+double silhouette_sample(const double *x, const int *y, int n, int m, int k, int samples) {
+    if (samples > n) samples = n;
+    const int stride = n / samples;
+    double total = 0.0;
+
+    #pragma omp parallel
+    {
+        double *dist_sum = (double *)malloc(k * sizeof(double));
+        int *count = (int *)malloc(k * sizeof(int));
+        if (dist_sum == NULL || count == NULL) {
+            puts("Memory allocation error...");
+            exit(1);
+        }
+
+        #pragma omp for reduction(+:total) schedule(dynamic, 16)
+        for (int s = 0; s < samples; s++) {
+            const int i = s * stride;
+            for (int j = 0; j < k; j++) {
+                dist_sum[j] = 0.0;
+                count[j] = 0;
+            }
+            for (int t = 0; t < samples; t++) {
+                const int o = t * stride;
+                if (o == i) continue;
+                dist_sum[y[o]] += euclidean_distance(&x[i * m], &x[o * m], m);
+                count[y[o]]++;
+            }
+
+            // a: distância média ao próprio cluster; b: ao cluster vizinho mais próximo
+            if (count[y[i]] == 0) continue;
+            double a = dist_sum[y[i]] / count[y[i]];
+            double b = DBL_MAX;
+            for (int j = 0; j < k; j++) {
+                if (j != y[i] && count[j] > 0 && dist_sum[j] / count[j] < b) {
+                    b = dist_sum[j] / count[j];
+                }
+            }
+            if (b == DBL_MAX) continue;
+            total += (b - a) / (a > b ? a : b);
+        }
+
+        free(dist_sum);
+        free(count);
+    }
+
+    return total / samples;
+}
+
+// Ponto mais distante do próprio centróide entre os pontos do cluster c
+// (ou entre todos os pontos, se c < 0); devolve -1 se não houver pontos
+int farthest_point(const double *x, const int *y, int n, int m, const double *centroids, int c) {
+    double far_dist = -1.0;
+    int far_point = -1;
+
+    #pragma omp parallel
+    {
+        double far_dist_local = -1.0;
+        int far_point_local = -1;
+
+        #pragma omp for schedule(static)
+        for (int i = 0; i < n; i++) {
+            if (c >= 0 && y[i] != c) continue;
+            double dist = euclidean_distance(&x[i * m], &centroids[y[i] * m], m);
+            if (dist > far_dist_local) {
+                far_dist_local = dist;
+                far_point_local = i;
+            }
+        }
+
+        #pragma omp critical
+        {
+            if (far_dist_local > far_dist || (far_dist_local == far_dist && far_point_local < far_point)) {
+                far_dist = far_dist_local;
+                far_point = far_point_local;
+            }
+        }
+    }
+
+    return far_point;
+}
 
-    // Libera a memória dos centróides
-    for (int i = 0; i < k; i++) {
-        free(centroids[i]);
+// Divide o cluster c em dois (estilo bisseção): o novo centróide k recebe o
+// ponto do cluster mais distante do centróide atual. Se c estiver vazio, usa
+// o ponto mais distante do seu centróide em toda a base.
+void split_cluster(const double *x, const int *y, int n, int m, double *centroids, int c, int k) {
+    int far_point = farthest_point(x, y, n, m, centroids, c);
+    if (far_point < 0) {
+        far_point = farthest_point(x, y, n, m, centroids, -1);
     }
+
+    for (int l = 0; l < m; l++) {
+        centroids[k * m + l] = x[far_point * m + l];
+    }
+}
+
+// Varredura de k em [k_min, k_max] numa única execução: cada k parte da
+// solução anterior com o cluster de maior inércia dividido em dois, reaproveitando
+// dados, rótulos e centróides. Imprime inércia e silhueta amostrada por k e
+// deixa em y os rótulos do k com a melhor silhueta.
+void kmeans_sweep(const double *x, int *y, int n, int m, int k_min, int k_max) {
+    double *centroids = (double *)malloc(k_max * m * sizeof(double));
+    double *sse = (double *)malloc(k_max * sizeof(double));
+    int *y_best = (int *)malloc(n * sizeof(int));
+    if (centroids == NULL || sse == NULL || y_best == NULL) {
+        puts("Memory allocation error...");
+        exit(1);
+    }
+
+    double best_score = -DBL_MAX;
+    int best_k = k_min;
+    init_centroids(x, centroids, m, k_min);
+
+    for (int k = k_min; k <= k_max; k++) {
+        double start = omp_get_wtime();
+        if (k > k_min) {
+            int worst = 0;
+            for (int j = 1; j < k - 1; j++) {
+                if (sse[j] > sse[worst]) worst = j;
+            }
+            split_cluster(x, y, n, m, centroids, worst, k - 1);
+        }
+        kmeans(x, NULL, y, n, m, k, centroids);
+        double inertia = cluster_sse(x, y, n, m, centroids, k, sse);
+        double elapsed = omp_get_wtime() - start;
+        double score = silhouette_sample(x, y, n, m, k, SILHOUETTE_SAMPLES);
+
+        printf("k = %d: inertia %.6e, silhouette %.4f, %.3f s\n", k, inertia, score, elapsed);
+        if (score > best_score) {
+            best_score = score;
+            best_k = k;
+            memcpy(y_best, y, n * sizeof(int));
+        }
+    }
+
+    printf("Best k by silhouette: %d\n", best_k);
+    memcpy(y, y_best, n * sizeof(int));
+
     free(centroids);
+    free(sse);
+    free(y_best);
 }
 
 void fprintf_result(const char *fn, const int* const y, const int n) {
@@ -156,9 +548,34 @@ void fprintf_result(const char *fn, const int* const y, const int n) {
     fclose(fl);
 }
 
+// Lê o valor numérico de uma opção; valores não numéricos ou não positivos
+// são rejeitados em vez de virarem 0 e desligarem a opção em silêncio
+int option_int(const char *s) {
+    char *end;
+    errno = 0;
+    long v = strtol(s, &end, 10);
+    if (end == s || *end != '\0' || errno != 0 || v < 1 || v > INT_MAX) {
+        puts("Values of input parameters are incorrect...");
+        exit(1);
+    }
+    return (int)v;
+}
+
+double option_double(const char *s) {
+    char *end;
+    errno = 0;
+    double v = strtod(s, &end);
+    if (end == s || *end != '\0' || errno != 0 || !(v > 0.0) || isinf(v)) {
+        puts("Values of input parameters are incorrect...");
+        exit(1);
+    }
+    return v;
+}
+
 int main(int argc, char **argv) {
     if (argc < 6) {
         puts("Not enough parameters...");
+        puts("Usage: kmeans-openmp <data> <n> <m> <k> <result> [--coreset <t>] [--eps <e>] [--compare] [--sweep <k_max>]");
         exit(1);
     }
     const int n = atoi(argv[2]), m = atoi(argv[3]), k = atoi(argv[4]);
@@ -166,7 +583,43 @@ int main(int argc, char **argv) {
         puts("Values of input parameters are incorrect...");
         exit(1);
     }
-    double *x = (double*)malloc(n * m * sizeof(double));
+    // Parâmetros opcionais do pipeline com coreset
+    int coreset_t = 0, coreset_compare = 0, sweep_k_max = 0;
+    double coreset_eps = 0.0;
+    for (int a = 6; a < argc; a++) {
+        if (strcmp(argv[a], "--compare") == 0) {
+            coreset_compare = 1;
+            continue;
+        }
+        // As demais opções exigem um valor
+        if (a + 1 == argc) {
+            puts("Values of input parameters are incorrect...");
+            exit(1);
+        }
+        if (strcmp(argv[a], "--coreset") == 0) {
+            coreset_t = option_int(argv[++a]);
+        } else if (strcmp(argv[a], "--eps") == 0) {
+            coreset_eps = option_double(argv[++a]);
+        } else if (strcmp(argv[a], "--sweep") == 0) {
+            sweep_k_max = option_int(argv[++a]);
+        } else {
+            printf("Unknown option %s...\n", argv[a]);
+            exit(1);
+        }
+    }
+    if (coreset_t < 0 || coreset_eps < 0.0 || (coreset_t > 0 && coreset_t < k) ||
+        (sweep_k_max != 0 && (sweep_k_max < k || sweep_k_max > n || coreset_t > 0 || coreset_eps > 0.0)) ||
+        (coreset_compare && coreset_t == 0 && coreset_eps == 0.0)) {
+        puts("Values of input parameters are incorrect...");
+        exit(1);
+    }
+    if (coreset_t == 0 && coreset_eps > 0.0) {
+        coreset_t = coreset_size_for_error(m, k, coreset_eps, n);
+    }
+    // Usa o cache em memória compartilhada do kmeans-loader, se existir
+    double *x = dataset_shm_attach(argv[1], (size_t)n * m);
+    const int x_shared = x != NULL;
+    if (!x_shared) x = (double*)malloc(n * m * sizeof(double));
     if (x == NULL) {
         puts("Memory allocation error...");
         exit(1);
@@ -174,13 +627,29 @@ int main(int argc, char **argv) {
     int *y = (int*)malloc(n * sizeof(int));
     if (y == NULL) {
         puts("Memory allocation error...");
-        free(x);
+        dataset_release(x, (size_t)n * m, x_shared);
         exit(1);
     }
-    fscanf_data(argv[1], x, n * m);
-    kmeans(x, y, n, m, k);
+    for (int i = 0; i < n; i++) {
+        y[i] = -1;
+    }
+    if (!x_shared) fscanf_data(argv[1], x, n * m);
+    if (sweep_k_max > 0) {
+        kmeans_sweep(x, y, n, m, k, sweep_k_max);
+    } else if (coreset_t > 0) {
+        kmeans_coreset(x, y, n, m, k, coreset_t, coreset_compare);
+    } else {
+        double *centroids = (double*)malloc(k * m * sizeof(double));
+        if (centroids == NULL) {
+            puts("Memory allocation error...");
+            exit(1);
+        }
+        init_centroids(x, centroids, m, k);
+        kmeans(x, NULL, y, n, m, k, centroids);
+        free(centroids);
+    }
     fprintf_result(argv[5], y, n);
-    free(x);
+    dataset_release(x, (size_t)n * m, x_shared);
     free(y);
     return 0;
 }
\ No newline at end of file
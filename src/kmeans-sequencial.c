@@ -7,6 +7,7 @@ Tempo sequencial: 161.055 segundos
 #include <time.h>
 #include <math.h>
 #include <float.h>
+#include "dataset-shm.h"
 
 double euclidean_distance(double *a, double *b, int m) {
 	double sum = 0.0;
@@ -130,7 +131,10 @@ int main(int argc, char **argv) {
 		puts("Values of input parameters are incorrect...");
 		exit(1);
 	}
-	double *x = (double*)malloc(n * m * sizeof(double));
+	// Usa o cache em memória compartilhada do kmeans-loader, se existir
+	double *x = dataset_shm_attach(argv[1], (size_t)n * m);
+	const int x_shared = x != NULL;
+	if (!x_shared) x = (double*)malloc(n * m * sizeof(double));
 	if (x == NULL) {
 		puts("Memory allocation error...");
 		exit(1);
@@ -138,13 +142,13 @@ int main(int argc, char **argv) {
 	int *y = (int*)malloc(n * sizeof(int));
 	if (y == NULL) {
 		puts("Memory allocation error...");
-		free(x);
+		dataset_release(x, (size_t)n * m, x_shared);
 		exit(1);
 	}	
-	fscanf_data(argv[1], x, n * m);
+	if (!x_shared) fscanf_data(argv[1], x, n * m);
 	kmeans(x, y, n, m, k);
 	fprintf_result(argv[5], y, n);
-	free(x);
+	dataset_release(x, (size_t)n * m, x_shared);
 	free(y);
 	return 0;
 }